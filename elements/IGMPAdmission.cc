@@ -0,0 +1,122 @@
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include "IGMPAdmission.hh"
+
+CLICK_DECLS
+
+IGMPAdmission::IGMPAdmission() {}
+
+static bool parse_prefix(const String& word, IPAddress& addr, IPAddress& mask) {
+    if (word == "any") {
+        addr = IPAddress();
+        mask = IPAddress();
+        return true;
+    }
+    return IPPrefixArg(true).parse(word, addr, mask);
+}
+
+int IGMPAdmission::add_rule(const String& conf, ErrorHandler* errh) {
+
+    Vector<String> words;
+    cp_spacevec(conf, words);
+
+    IPAddress src_addr, src_mask, group_addr, group_mask;
+    int limit = -1;
+
+    if ((words.size() != 3 && words.size() != 5)
+        || (words[0] != "permit" && words[0] != "deny")
+        || !parse_prefix(words[1], src_addr, src_mask)
+        || !parse_prefix(words[2], group_addr, group_mask)
+        || (words.size() == 5 && (words[3] != "limit" || !IntArg().parse(words[4], limit) || limit < 0))) {
+        return errh->error("bad RULE '%s', expected 'permit|deny SOURCE GROUP [limit N]'", conf.c_str());
+    }
+
+    PendingRule pending;
+    pending.rule.src_mask   = src_mask.addr();
+    pending.rule.src_addr   = src_addr.addr() & src_mask.addr();
+    pending.rule.src_len    = src_mask.mask_to_prefix_len();
+    pending.rule.permit     = words[0] == "permit";
+    pending.rule.limit      = limit;
+    pending.group_len       = group_mask.mask_to_prefix_len();
+    pending.group_addr      = ntohl(group_addr.addr() & group_mask.addr());
+
+    if (pending.rule.src_len < 0 || pending.group_len < 0) {
+        return errh->error("bad RULE '%s', masks must be prefixes", conf.c_str());
+    }
+
+    _pending.push_back(pending);
+    return 0;
+}
+
+int IGMPAdmission::insert(Vector<Node>& nodes, int node, uint32_t addr, int len) {
+    // Walks the prefix down from node, adding the missing nodes
+    Node empty = {{-1, -1}, -1};
+    for (int depth = 0; depth < len; depth++) {
+        int bit = (addr >> (31 - depth)) & 1;
+        if (nodes[node].child[bit] < 0) {
+            nodes[node].child[bit] = nodes.size();
+            nodes.push_back(empty);
+        }
+        node = nodes[node].child[bit];
+    }
+    return node;
+}
+
+void IGMPAdmission::compile() {
+
+    Node empty = {{-1, -1}, -1};
+    _group_nodes.clear();
+    _source_nodes.clear();
+    _rules.clear();
+    _group_nodes.push_back(empty);
+
+    // Each group prefix node holds a trie of the source prefixes of its rules.
+    // A source node keeps the first configured rule with those prefixes.
+    for (int i = 0; i < _pending.size(); i++) {
+        const PendingRule& pending = _pending[i];
+        int group = insert(_group_nodes, 0, pending.group_addr, pending.group_len);
+        if (_group_nodes[group].value < 0) {
+            _group_nodes[group].value = _source_nodes.size();
+            _source_nodes.push_back(empty);
+        }
+        int source = insert(_source_nodes, _group_nodes[group].value, ntohl(pending.rule.src_addr), pending.rule.src_len);
+        if (_source_nodes[source].value < 0) {
+            _source_nodes[source].value = i;
+        }
+        _rules.push_back(pending.rule);
+        _rules.back().index = i;
+    }
+
+    _pending.clear();
+}
+
+const IGMPAdmission::Rule* IGMPAdmission::lookup(IPAddress src, IPAddress group) const {
+
+    if (_rules.empty()) {
+        return nullptr;
+    }
+
+    // Every group node on the path of the group address has a source trie
+    // that is walked along the source address. The matching rule configured
+    // first wins, so a lookup visits at most 33 x 33 nodes.
+    uint32_t group_bits  = ntohl(group.addr());
+    uint32_t source_bits = ntohl(src.addr());
+    int best = -1;
+
+    int node = 0;
+    for (int depth = 0; node >= 0; depth++) {
+        for (int source = _group_nodes[node].value, sdepth = 0; source >= 0; sdepth++) {
+            int rule = _source_nodes[source].value;
+            if (rule >= 0 && (best < 0 || rule < best)) {
+                best = rule;
+            }
+            source = sdepth < 32 ? _source_nodes[source].child[(source_bits >> (31 - sdepth)) & 1] : -1;
+        }
+        node = depth < 32 ? _group_nodes[node].child[(group_bits >> (31 - depth)) & 1] : -1;
+    }
+    return best < 0 ? nullptr : &_rules[best];
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(IGMPAdmission)
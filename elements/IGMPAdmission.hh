@@ -0,0 +1,73 @@
+#ifndef CLICK_IGMPAdmission_HH
+#define CLICK_IGMPAdmission_HH
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/ipaddress.hh>
+
+
+/*
+    IGMP Admission - Group admission policy for IGMPQuerier.
+    Rules have the form
+        permit|deny SOURCE GROUP [limit N]
+    where SOURCE and GROUP are prefixes or 'any'. The optional limit is the
+    maximum number of groups a single source may create through this rule.
+    Groups created through other rules don't count against it.
+
+    The first configured rule that matches is applied, like an access list.
+    The rules are compiled into a binary trie on the group prefix, where each
+    node holds a binary trie on the source prefixes of its rules. A lookup
+    only walks the nodes on the path of the group and source address, so its
+    cost doesn't depend on the number of rules.
+*/
+
+
+CLICK_DECLS
+
+class ErrorHandler;
+
+class IGMPAdmission {
+    public:
+
+        struct Rule {
+            uint32_t src_addr;
+            uint32_t src_mask;
+            int      src_len;
+            bool     permit;
+            int      limit; // -1 if unlimited
+            int      index; // Position in the configuration
+        };
+
+        IGMPAdmission();
+
+        int add_rule(const String&, ErrorHandler*);
+        void compile();
+        bool empty() const {return _rules.empty();}
+
+        // Returns the matching rule, or nullptr if no rule matches
+        const Rule* lookup(IPAddress src, IPAddress group) const;
+
+        // Rule as configured, before compile()
+        struct PendingRule {
+            Rule     rule;
+            uint32_t group_addr;
+            int      group_len;
+        };
+
+    private:
+
+        struct Node {
+            int child[2];
+            int value; // Group node: root of its source trie, source node: first rule, -1 if none
+        };
+
+        static int insert(Vector<Node>&, int, uint32_t, int);
+
+        Vector<Node>        _group_nodes;
+        Vector<Node>        _source_nodes;
+        Vector<Rule>        _rules;
+        Vector<PendingRule> _pending;
+};
+
+CLICK_ENDDECLS
+
+#endif
@@ -0,0 +1,61 @@
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include "IGMPClassify.hh"
+
+CLICK_DECLS
+
+#define IGMP_DISPATCH 0xff
+
+IGMPClassify::IGMPClassify(): _mcast_addr(0), _mcast_mask(0) {}
+
+IGMPClassify::~IGMPClassify() {}
+
+int IGMPClassify::configure(Vector<String>& conf, ErrorHandler* errh) {
+
+    IPAddress mcast_addr = IPAddress("224.0.0.0");
+    IPAddress mcast_mask = IPAddress("255.0.0.0");
+
+    if (Args(conf, this, errh).read("MULTICAST", IPPrefixArg(true), mcast_addr, mcast_mask)
+			      .complete() < 0) return -1;
+
+    _mcast_mask = mcast_mask.addr();
+    _mcast_addr = mcast_addr.addr() & _mcast_mask;
+
+    // Protocol dispatch: UDP is forwarded, IGMP is split further on type
+    memset(_proto_output, OUT_OTHER, sizeof(_proto_output));
+    _proto_output[IP_PROTO_UDP]  = OUT_UDP;
+    _proto_output[IP_PROTO_IGMP] = IGMP_DISPATCH;
+
+    // IGMP dispatch: only reports are handled by the querier
+    memset(_igmp_output, OUT_OTHER, sizeof(_igmp_output));
+    _igmp_output[IGMP_TYPE_MEMBERSHIP_REPORT] = OUT_REPORT;
+
+    return 0;
+}
+
+void IGMPClassify::push(int, Packet* p) {
+
+    if (!p->has_network_header() || p->network_length() < (int) sizeof(click_ip)) {
+        checked_output_push(OUT_OTHER, p);
+        return;
+    }
+
+    const click_ip* iph = p->ip_header();
+
+    if ((iph->ip_dst.s_addr & _mcast_mask) != _mcast_addr) {
+        output(OUT_UNICAST).push(p);
+        return;
+    }
+
+    int port = _proto_output[iph->ip_p];
+    if (port == IGMP_DISPATCH) {
+        const uint8_t* igmp = (const uint8_t*) iph + (iph->ip_hl << 2);
+        port = igmp < p->end_data() ? _igmp_output[*igmp] : OUT_OTHER;
+    }
+
+    checked_output_push(port, p);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IGMPClassify)
@@ -0,0 +1,54 @@
+#ifndef CLICK_IGMPClassify_HH
+#define CLICK_IGMPClassify_HH
+#include <click/element.hh>
+#include <clicknet/ip.h>
+#include "IGMPHeaders.hh"
+
+
+/*
+    IGMP Classify - Router side IGMP component.
+    Splits incoming traffic for an IGMPQuerier in a single pass over the
+    IP header, replacing a chain of IPClassifiers. Like IPClassifier, the
+    IP header annotation must be set.
+
+    Output:
+        [0]: IGMP Membership Reports (multicast destination)
+        [1]: Multicast UDP packets
+        [2]: Non-multicast packets
+        [3]: Other multicast packets, and packets without a (complete) annotated
+             IP header, dropped if not connected
+*/
+
+
+CLICK_DECLS
+
+/*
+    Configuration parameters:
+        MULTICAST: Destination prefix treated as multicast, default = 224.0.0.0/8
+*/
+class IGMPClassify : public Element {
+    public:
+
+        IGMPClassify();
+        ~IGMPClassify();
+
+        const char *class_name() const {return "IGMPClassify";}
+        const char *port_count() const {return "1/3-4";}
+        const char *processing() const {return PUSH;}
+        int configure(Vector<String>&, ErrorHandler*);
+        void push(int, Packet*);
+
+    private:
+
+        enum { OUT_REPORT = 0, OUT_UDP = 1, OUT_UNICAST = 2, OUT_OTHER = 3 };
+
+        // Output per IP protocol and per IGMP type, filled in configure
+        uint8_t   _proto_output[256];
+        uint8_t   _igmp_output[256];
+        uint32_t  _mcast_addr;
+        uint32_t  _mcast_mask;
+};
+
+CLICK_ENDDECLS
+
+#endif
@@ -0,0 +1,103 @@
+#include <click/config.h>
+#include "IGMPCodec.hh"
+
+CLICK_DECLS
+
+uint8_t igmp_value_to_code(uint value) {
+    // The table is increasing, so binary search for the last entry <= value
+    if (value >= igmp_code_table[255]) {
+        return 255;
+    }
+    if (value < 128) {
+        return value;
+    }
+
+    int low  = 128;
+    int high = 255;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (igmp_code_table[mid] <= value) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+uint16_t igmp_checksum(const unsigned char* data, int len) {
+    // Sum 32-bit words in a 64-bit accumulator, four words per iteration.
+    // The carries are folded back in at the end.
+    uint64_t sum = 0;
+    uint32_t w[4];
+
+    while (len >= 16) {
+        memcpy(w, data, 16);
+        sum += (uint64_t) w[0] + w[1] + w[2] + w[3];
+        data += 16;
+        len  -= 16;
+    }
+    while (len >= 4) {
+        memcpy(w, data, 4);
+        sum += w[0];
+        data += 4;
+        len  -= 4;
+    }
+    if (len >= 2) {
+        uint16_t half;
+        memcpy(&half, data, 2);
+        sum += half;
+        data += 2;
+        len  -= 2;
+    }
+    if (len == 1) {
+        uint16_t odd_byte = 0;
+        *(unsigned char*) &odd_byte = *data;
+        sum += odd_byte;
+    }
+
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum & 0xffff;
+}
+
+WritablePacket* igmp_make_packet(IPAddress src, IPAddress dst, uint16_t ip_id, uint igmp_len) {
+
+    WritablePacket* p = Packet::make(IGMP_IP_HEADER_LEN + igmp_len);
+    if (p == 0) {
+        click_chatter("Failed to create packet.");
+        return nullptr;
+    }
+    memset(p->data(), 0, p->length());
+
+    // IP
+    click_ip* iph = (click_ip*) p->data();
+    iph->ip_v   = 4;
+    iph->ip_hl  = IGMP_IP_HEADER_LEN >> 2;
+    iph->ip_len = htons(p->length());
+    iph->ip_id  = htons(ip_id);
+    iph->ip_ttl = 1;
+    iph->ip_p   = IP_PROTO_IGMP;
+    iph->ip_src = src;
+    iph->ip_dst = dst;
+
+    // IP Option: Router Alert
+    IP_options* ra = (IP_options*) (iph + 1);
+    ra->type   = 148;
+    ra->length = 4;
+    ra->value  = 0;
+
+    iph->ip_sum = igmp_checksum((unsigned char*) iph, IGMP_IP_HEADER_LEN);
+
+    // Annotations
+    p->set_dst_ip_anno(dst);
+    p->set_ip_header(iph, IGMP_IP_HEADER_LEN);
+
+    return p;
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(IGMPCodec)
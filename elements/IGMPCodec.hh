@@ -0,0 +1,174 @@
+#ifndef CLICK_IGMPCodec_HH
+#define CLICK_IGMPCodec_HH
+#include <click/packet.hh>
+#include <click/ipaddress.hh>
+#include <clicknet/ip.h>
+#include "IGMPHeaders.hh"
+
+
+/*
+    IGMP Codec - Shared IGMP encoding and decoding for IGMPQuerier, IGMPResponder
+    and IGMPSnooping.
+
+    - Max Resp Code / QQIC conversion through a constexpr lookup table (RFC 3376, 4.1.1 and 4.1.7).
+      Max Resp Code is in units of 100ms, QQIC in units of 1s.
+    - Building of IGMP packets (IP header with Router Alert option).
+    - Checksumming with 32-bit words, for multi-record reports.
+    - Zero-copy, bounds checked views over received queries and reports.
+*/
+
+
+CLICK_DECLS
+
+/* Code <-> value conversion */
+
+// Decoded value of a Max Resp Code or QQIC, in units of the field
+constexpr uint16_t igmp_code_value(uint8_t code) {
+    return code < 128 ? code : ((code & 0x0f) | 0x10) << (((code & 0x70) >> 4) + 3);
+}
+
+#define IGMP_CODE_ROW(r) \
+    igmp_code_value(r + 0x0), igmp_code_value(r + 0x1), igmp_code_value(r + 0x2), igmp_code_value(r + 0x3), \
+    igmp_code_value(r + 0x4), igmp_code_value(r + 0x5), igmp_code_value(r + 0x6), igmp_code_value(r + 0x7), \
+    igmp_code_value(r + 0x8), igmp_code_value(r + 0x9), igmp_code_value(r + 0xa), igmp_code_value(r + 0xb), \
+    igmp_code_value(r + 0xc), igmp_code_value(r + 0xd), igmp_code_value(r + 0xe), igmp_code_value(r + 0xf)
+
+static constexpr uint16_t igmp_code_table[256] = {
+    IGMP_CODE_ROW(0x00), IGMP_CODE_ROW(0x10), IGMP_CODE_ROW(0x20), IGMP_CODE_ROW(0x30),
+    IGMP_CODE_ROW(0x40), IGMP_CODE_ROW(0x50), IGMP_CODE_ROW(0x60), IGMP_CODE_ROW(0x70),
+    IGMP_CODE_ROW(0x80), IGMP_CODE_ROW(0x90), IGMP_CODE_ROW(0xa0), IGMP_CODE_ROW(0xb0),
+    IGMP_CODE_ROW(0xc0), IGMP_CODE_ROW(0xd0), IGMP_CODE_ROW(0xe0), IGMP_CODE_ROW(0xf0)
+};
+
+#undef IGMP_CODE_ROW
+
+static_assert(igmp_code_table[0x7f] == 127 && igmp_code_table[0x80] == 128 && igmp_code_table[0xff] == 31744,
+              "bad IGMP code table");
+
+// Largest code whose value doesn't exceed the given value
+uint8_t igmp_value_to_code(uint value);
+
+inline uint igmp_code_to_ms(uint8_t code) {
+    return igmp_code_table[code] * 100;
+}
+
+inline uint8_t igmp_ms_to_code(uint ms) {
+    return igmp_value_to_code(ms / 100);
+}
+
+inline uint igmp_qqic_to_ms(uint8_t qqic) {
+    return igmp_code_table[qqic] * 1000;
+}
+
+inline uint8_t igmp_ms_to_qqic(uint ms) {
+    return igmp_value_to_code(ms / 1000);
+}
+
+
+/* Packet building */
+
+#define IGMP_IP_HEADER_LEN (sizeof(click_ip) + sizeof(IP_options))
+
+// Internet checksum, summing 32-bit words. Same result as click_in_cksum.
+uint16_t igmp_checksum(const unsigned char* data, int len);
+
+/*
+    Returns a packet with a checksummed IP header (TTL 1, Router Alert option)
+    followed by igmp_len zeroed bytes for the IGMP message at igmp_payload(p).
+    Fill in the message, then set its checksum with igmp_checksum.
+*/
+WritablePacket* igmp_make_packet(IPAddress src, IPAddress dst, uint16_t ip_id, uint igmp_len);
+
+inline unsigned char* igmp_payload(WritablePacket* p) {
+    return p->data() + IGMP_IP_HEADER_LEN;
+}
+
+
+/* Packet views */
+
+// Start and end of the IGMP message of an IP packet with IP header annotation
+inline const uint8_t* igmp_message(const Packet* p) {
+    return p->network_header() + (p->ip_header()->ip_hl << 2);
+}
+
+class IGMPQueryView {
+    public:
+
+        IGMPQueryView(const Packet* p) {
+            const uint8_t* msg = igmp_message(p);
+            _query = msg + sizeof(igmp_memb_query) <= p->end_data() ? (const igmp_memb_query*) msg : nullptr;
+        }
+
+        bool valid() const {return _query && _query->igmp_type == IGMP_TYPE_MEMBERSHIP_QUERY;}
+        uint8_t type() const {return _query->igmp_type;}
+        uint max_resp_ms() const {return igmp_code_to_ms(_query->igmp_max_resp_code);}
+        IPAddress group() const {return IPAddress(_query->igmp_group_address);}
+        uint8_t qrv() const {return _query->igmp_S_QRV & IGMP_QRV_MASK;}
+        uint qqi_ms() const {return igmp_qqic_to_ms(_query->igmp_QQIC);}
+        uint16_t num_sources() const {return ntohs(_query->igmp_num_sources);}
+
+    private:
+
+        const igmp_memb_query* _query;
+};
+
+// Iterates over the variable length group records of a report
+class IGMPRecordIterator {
+    public:
+
+        IGMPRecordIterator(const uint8_t* records, const uint8_t* end, int count)
+            : _record(records), _end(end), _left(count) {
+            check();
+        }
+
+        operator bool() const {return _left > 0;}
+        const igmp_group_record* operator->() const {return (const igmp_group_record*) _record;}
+
+        uint8_t type() const {return operator->()->igmp_record_type;}
+        IPAddress group() const {return IPAddress(operator->()->igmp_multicast_addr);}
+        uint16_t num_sources() const {return ntohs(operator->()->igmp_num_sources);}
+
+        IGMPRecordIterator& operator++() {
+            _record += sizeof(igmp_group_record) + (num_sources() + operator->()->igmp_aux_data) * 4;
+            _left--;
+            check();
+            return *this;
+        }
+
+    private:
+
+        void check() {
+            // Stop at a truncated record
+            if (_left > 0 && _record + sizeof(igmp_group_record) > _end) {
+                _left = 0;
+            }
+        }
+
+        const uint8_t* _record;
+        const uint8_t* _end;
+        int            _left;
+};
+
+class IGMPReportView {
+    public:
+
+        IGMPReportView(const Packet* p): _end(p->end_data()) {
+            const uint8_t* msg = igmp_message(p);
+            _report = msg + sizeof(igmp_memb_report) <= _end ? (const igmp_memb_report*) msg : nullptr;
+        }
+
+        bool valid() const {return _report && _report->igmp_type == IGMP_TYPE_MEMBERSHIP_REPORT;}
+        uint16_t num_records() const {return ntohs(_report->igmp_num_group_rec);}
+        IGMPRecordIterator records() const {
+            return IGMPRecordIterator((const uint8_t*) (_report + 1), _end, num_records());
+        }
+
+    private:
+
+        const igmp_memb_report* _report;
+        const uint8_t*          _end;
+};
+
+CLICK_ENDDECLS
+
+#endif
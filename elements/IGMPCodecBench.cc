@@ -0,0 +1,93 @@
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include "IGMPCodecBench.hh"
+#include "IGMPCodec.hh"
+
+CLICK_DECLS
+
+IGMPCodecBench::IGMPCodecBench(): _iterations(1000000), _records(64) {}
+
+IGMPCodecBench::~IGMPCodecBench() {}
+
+int IGMPCodecBench::configure(Vector<String>& conf, ErrorHandler* errh) {
+
+    if (Args(conf, this, errh).read("ITERATIONS", _iterations)
+			      .read("RECORDS", _records)
+			      .complete() < 0) return -1;
+
+    if (_iterations == 0) {
+        return errh->error("ITERATIONS must be positive");
+    }
+    return 0;
+}
+
+static double ns_per_call(const Timestamp& start, uint iterations) {
+    return (double) (Timestamp::now_steady() - start).nsecval() / iterations;
+}
+
+String IGMPCodecBench::handle_run(Element* e, void*) {
+    IGMPCodecBench* elem = (IGMPCodecBench*) e;
+    uint iterations      = elem->_iterations;
+    volatile uint sink   = 0;
+
+    // Random codes, so the conversions can't be folded at compile time
+    uint8_t codes[256];
+    for (int i = 0; i < 256; i++) {
+        codes[i] = click_random(0, 255);
+    }
+
+    // Report with RECORDS group records
+    uint len = sizeof(igmp_memb_report) + elem->_records * sizeof(igmp_group_record);
+    unsigned char* report = new unsigned char[len];
+    for (uint i = 0; i < len; i++) {
+        report[i] = click_random(0, 255);
+    }
+
+    StringAccum sa;
+    Timestamp start;
+
+    start = Timestamp::now_steady();
+    for (uint i = 0; i < iterations; i++) {
+        sink += igmp_code_value(codes[i & 255]) * 100;
+    }
+    sa << "code_to_ms computed   " << ns_per_call(start, iterations) << " ns\n";
+
+    start = Timestamp::now_steady();
+    for (uint i = 0; i < iterations; i++) {
+        sink += igmp_code_to_ms(codes[i & 255]);
+    }
+    sa << "code_to_ms table      " << ns_per_call(start, iterations) << " ns\n";
+
+    start = Timestamp::now_steady();
+    for (uint i = 0; i < iterations; i++) {
+        sink += igmp_ms_to_code(i);
+    }
+    sa << "ms_to_code table      " << ns_per_call(start, iterations) << " ns\n";
+
+    start = Timestamp::now_steady();
+    for (uint i = 0; i < iterations; i++) {
+        report[2] = i;
+        sink += click_in_cksum(report, len);
+    }
+    sa << "click_in_cksum        " << ns_per_call(start, iterations) << " ns (" << len << " bytes)\n";
+
+    start = Timestamp::now_steady();
+    for (uint i = 0; i < iterations; i++) {
+        report[2] = i;
+        sink += igmp_checksum(report, len);
+    }
+    sa << "igmp_checksum         " << ns_per_call(start, iterations) << " ns (" << len << " bytes)\n";
+
+    delete[] report;
+    return sa.take_string();
+}
+
+void IGMPCodecBench::add_handlers() {
+    add_read_handler("run", &handle_run, (void*)0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IGMPCodecBench)
+ELEMENT_REQUIRES(IGMPCodec)
@@ -3,8 +3,10 @@
 
 #include <clicknet/ip.h>
 
-#define IGMP_TYPE_MEMBERSHIP_QUERY   0x11
-#define IGMP_TYPE_MEMBERSHIP_REPORT  0x22
+#define IGMP_TYPE_MEMBERSHIP_QUERY     0x11
+#define IGMP_TYPE_MEMBERSHIP_REPORT    0x22
+#define IGMP_TYPE_V2_MEMBERSHIP_REPORT 0x16
+#define IGMP_TYPE_V2_LEAVE_GROUP       0x17
 
 /* Mask usage: 
         igmp_S_QRV && <MASK> -> desired field
@@ -37,6 +39,8 @@ struct igmp_memb_report {
 #define IGMP_MODE_IS_EXCLUDE        2
 #define IGMP_CHANGE_TO_INCLUDE_MODE 3
 #define IGMP_CHANGE_TO_EXCLUDE_MODE 4
+#define IGMP_ALLOW_NEW_SOURCES      5
+#define IGMP_BLOCK_OLD_SOURCES      6
 
 struct igmp_group_record {
     uint8_t  igmp_record_type;
@@ -1,11 +1,15 @@
 #include <click/config.h>
 #include <click/args.hh>
 #include <click/error.hh>
+#include <click/handler.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
 #include "IGMPQuerier.hh"
 
 CLICK_DECLS
 
-IGMPQuerier::IGMPQuerier(): _query_timer(this), _ctr(1), _s_qrv(0) {
+IGMPQuerier::IGMPQuerier(): _query_timer(this), _phase_shift(0), _phase_applied(false), _startup_sent(0), _ctr(1), _s_qrv(0), _drops(0),
+                             _default_permit(true), _max_groups(0), _rejected(0), _rejected_limit(0) {
     _multicast_state = Vector<GroupState>();
 }
 
@@ -20,6 +24,10 @@ int IGMPQuerier::configure(Vector<String>& conf, ErrorHandler* errh) {
     double sqi   = -1;  // In seconds
     int  sqc    = -1;
     int lmqc    = -1;
+    double phase  = -1; // In seconds
+    double jitter = 0;  // In seconds
+    String default_action = "permit";
+    Vector<String> rules;
 
     if (Args(conf, this, errh).read_mp("SOURCE", _src)
 			      .read("RV", rv)
@@ -29,8 +37,24 @@ int IGMPQuerier::configure(Vector<String>& conf, ErrorHandler* errh) {
 		 	      .read("SQI", sqi)
 			      .read("SQC", sqc)
 			      .read("LMQC", lmqc)
+			      .read("PHASE", phase)
+			      .read("JITTER", jitter)
+			      .read_all("RULE", AnyArg(), rules)
+			      .read("DEFAULT", WordArg(), default_action)
+			      .read("MAXGROUPS", _max_groups)
 			      .complete() < 0) return -1;
 
+    for (int i = 0; i < rules.size(); i++) {
+        if (_admission.add_rule(cp_unquote(rules[i]), errh) < 0)
+            return -1;
+    }
+    _admission.compile();
+
+    if (default_action != "permit" && default_action != "deny") {
+        return errh->error("DEFAULT must be 'permit' or 'deny'");
+    }
+    _default_permit = default_action == "permit";
+
     _query_interval              = (uint) (qi * 1000);
     _query_resp_interval         = (uint) (qri * 1000);
     _max_resp_code_general_query = igmp_ms_to_code(_query_resp_interval);
@@ -38,119 +62,158 @@ int IGMPQuerier::configure(Vector<String>& conf, ErrorHandler* errh) {
     _last_memb_query_interval  = (uint) (lmqi * 1000);
     _last_memb_query_count     = lmqc < 0 ? rv : (uint) lmqc;
     _max_resp_code_group_query = igmp_ms_to_code(_last_memb_query_interval);
+    _qqic                      = igmp_ms_to_qqic(_query_interval);
 
     _startup_query_interval = sqi < 0 ? (uint) (_query_interval / 4) : (uint) (sqi * 1000);
     _startup_query_count    = sqc < 0 ? rv : sqc;
 
     _s_qrv = ((s << 4) | rv);
-    _query_timer.initialize(this);
-    _query_timer.schedule_after_msec(0);
+
+    _query_phase  = phase < 0 ? -1 : (int) (phase * 1000);
+    _query_jitter = (uint) (jitter * 1000);
+    if (_query_phase >= (int) _query_interval) {
+        return errh->error("PHASE must be smaller than QI");
+    }
+    if (_query_jitter >= _query_interval) {
+        return errh->error("JITTER must be smaller than QI");
+    }
 
     _group_membership_interval = (rv * _query_interval) + _query_resp_interval;
 
     return 0;
 }
 
+int IGMPQuerier::initialize(ErrorHandler*) {
+
+    if (_query_phase < 0) {
+        // Spread the IGMPQueriers of this router evenly over the query interval
+        int rank  = 0;
+        int count = 0;
+        for (int i = 0; i < router()->nelements(); i++) {
+            Element* e = router()->element(i);
+            if (e->cast("IGMPQuerier")) {
+                if (e == this) {
+                    rank = count;
+                }
+                count++;
+            }
+        }
+        _query_phase = (uint64_t) _query_interval * rank / count;
+    }
+
+    // The startup queries are spread proportionally over the startup query
+    // interval, the rest of the phase is added to the first regular interval.
+    uint first_query = (uint64_t) _query_phase * _startup_query_interval / _query_interval;
+    _phase_shift     = _query_phase - first_query;
+
+    _query_timer.initialize(this);
+    _next_query = Timestamp::now_steady() + Timestamp::make_msec(first_query);
+    _query_timer.schedule_at_steady(_next_query);
+
+    return 0;
+}
+
 Packet* IGMPQuerier::make_packet(IPAddress dst_addr = IPAddress("224.0.0.1")) {
 
-    size_t packetsize = sizeof(click_ip) + sizeof(IP_options) + sizeof(igmp_memb_query);
-    WritablePacket* p = Packet::make(packetsize);
+    bool general_query = dst_addr == IPAddress("224.0.0.1");
+
+    WritablePacket* p = igmp_make_packet(_src, dst_addr, _ctr, sizeof(igmp_memb_query));
     if (p == 0) {
-        click_chatter("Failed to create packet.");
         return nullptr;
     }
-    memset(p->data(), 0, p->length());
-    
-    // IP
-    click_ip* iph = (click_ip*) p->data();
-    iph->ip_v   = 4;
-    iph->ip_hl  =  (sizeof(click_ip) + sizeof(IP_options)) >> 2;
-    iph->ip_len = htons(p->length());
-    iph->ip_id  = htons(_ctr);
-    iph->ip_ttl = 1;
-    iph->ip_p   = 2;
-    iph->ip_src = _src;
-    iph->ip_dst = dst_addr;
-
-    // IP Option: Router Alert
-    IP_options* ra = (IP_options*) (iph + 1);
-    ra->type = 148;
-    ra->length = 4;
-    ra->value = 0;
-
-    iph->ip_sum = 0;
-    iph->ip_sum = click_in_cksum((unsigned char*) iph, sizeof(click_ip) + sizeof(IP_options));
-    
+
     // IGMP Query
-    igmp_memb_query* igmph = (igmp_memb_query*) (ra + 1);
+    igmp_memb_query* igmph = (igmp_memb_query*) igmp_payload(p);
     igmph->igmp_type             = IGMP_TYPE_MEMBERSHIP_QUERY;
-    igmph->igmp_max_resp_code    = dst_addr == IPAddress("224.0.0.1") ? _max_resp_code_general_query : _max_resp_code_group_query;
-    igmph->igmp_group_address    = dst_addr == IPAddress("224.0.0.1") ? IPAddress() : dst_addr;
+    igmph->igmp_max_resp_code    = general_query ? _max_resp_code_general_query : _max_resp_code_group_query;
+    igmph->igmp_group_address    = general_query ? IPAddress() : dst_addr;
     igmph->igmp_S_QRV            = _s_qrv;
-    igmph->igmp_QQIC             = _max_resp_code_general_query;
+    igmph->igmp_QQIC             = _qqic;
     igmph->igmp_num_sources      = 0;
-    igmph->igmp_checksum         = click_in_cksum((unsigned char*) igmph, sizeof(igmp_memb_query));
-
-    // Annotations
-    p->set_dst_ip_anno(IPAddress(iph->ip_dst));
-    p->set_ip_header(iph, sizeof(*iph));
+    igmph->igmp_checksum         = igmp_checksum((unsigned char*) igmph, sizeof(igmp_memb_query));
 
     return p;
 }
 
 void IGMPQuerier::run_timer(Timer* t) {
 
+    // Startup queries are counted separately, _ctr also counts group-specific queries
+    if (_startup_sent < _startup_query_count) {
+	_startup_sent++;
+    }
+
     uint interval = _query_interval;
-    if (_ctr < _startup_query_count) {
+    if (_startup_sent < _startup_query_count) {
 	interval = _startup_query_interval;
+    } else if (!_phase_applied) {
+	interval += _phase_shift;
+	_phase_applied = true;
     }
     Packet* p = make_packet();
     output(0).push(p);
     _ctr++;
-    _query_timer.schedule_after_msec(interval);
+
+    // Jitter is added to the nominal query time, so it doesn't shift the phase.
+    // Startup queries, including the last one, get no jitter: SQI may be
+    // shorter than JITTER, which would let a startup query fire after the next one.
+    _next_query += Timestamp::make_msec(interval);
+    bool next_startup = _startup_sent < _startup_query_count;
+    uint jitter       = _query_jitter && !next_startup ? click_random(0, _query_jitter) : 0;
+    _query_timer.schedule_at_steady(_next_query + Timestamp::make_msec(jitter));
 
 }
 
-void IGMPQuerier::push(int, Packet* p) {
+void IGMPQuerier::push(int port, Packet* p) {
 
-    WritablePacket* wp     = p->uniqueify();
-    click_ip* iph          = wp->ip_header();
+    // Packets are already classified by IGMPClassify, and are only read
+    const click_ip* iph = p->ip_header();
 
-    // Split based on IP protocol (UDP or IGMP)
-    if (iph->ip_p == 2) {
-        // IGMP
-        IP_options* ipo         = (IP_options*) (iph + 1);
-        igmp_memb_report* igmph =  (igmp_memb_report*) (ipo + 1);
+    if (port == 0) {
+        // IGMP Membership Reports
+        IGMPReportView report(p);
 
-        if (igmph->igmp_num_group_rec > 0) {
-            igmp_group_record* record = (igmp_group_record*) (igmph + 1);
+        if (report.valid()) {
+            for (IGMPRecordIterator record = report.records(); record; ++record) {
 
-            for (int i = 0; i < igmph->igmp_num_group_rec; i++) {
+                uint8_t record_type      = record.type();
+                IPAddress multicast_addr = record.group();
 
-                uint8_t record_type     = record->igmp_record_type;
-                uint32_t multicast_addr = record->igmp_multicast_addr;
+                // Admission policy, for records that create or refresh a group
+                const IGMPAdmission::Rule* rule = nullptr;
+                if (record_type == IGMP_CHANGE_TO_EXCLUDE_MODE || record_type == IGMP_MODE_IS_EXCLUDE) {
+                    rule = _admission.lookup(iph->ip_src, multicast_addr);
+                    if (rule ? !rule->permit : !_default_permit) {
+                        _rejected++;
+                        continue;
+                    }
+                }
 
                 // Handle state changes
                 if (record_type == IGMP_CHANGE_TO_EXCLUDE_MODE) {
 
                     // Existing groups
-                    bool group_exists = false;
-                    for (int i = 0; i < _multicast_state.size(); i++) {
-                        if (multicast_addr == _multicast_state[i].group_addr.addr()) {
-                            group_exists = true;
-                            break; 
-                        }
+                    int position = upper_group(multicast_addr);
+                    bool group_exists = position > 0 && _multicast_state[position - 1].group_addr == multicast_addr;
+                    if (group_exists) {
+                        _multicast_state[position - 1].reports++;
                     }
                     // New group
-                    if (!group_exists) {
+                    if (!group_exists && !within_limits(iph->ip_src, rule)) {
+                        _rejected_limit++;
+                    }
+                    else if (!group_exists) {
 			            GroupTimerData* timerdata = new GroupTimerData;
 			            timerdata->querier = this;
 			            timerdata->multicast_address = multicast_addr;
                         Timer* group_timer = new Timer(&IGMPQuerier::handleGroupTimeout, timerdata);
-                        GroupState new_group = GroupState {multicast_addr, group_timer, IGMP_MODE_IS_EXCLUDE};
+                        int limit_rule = rule && rule->limit >= 0 ? rule->index : -1;
+                        GroupState new_group = GroupState {multicast_addr, group_timer, IGMP_MODE_IS_EXCLUDE, 1, 0, iph->ip_src, limit_rule, false};
 			            group_timer->initialize(this);
 			            group_timer->schedule_after_msec(_group_membership_interval);
-                        _multicast_state.push_back(new_group);
+                        _multicast_state.insert(_multicast_state.begin() + position, new_group);
+                        if (limit_rule >= 0) {
+                            _source_groups[RuleSource {limit_rule, iph->ip_src}]++;
+                        }
                     }
                 }
                 else if (record_type == IGMP_CHANGE_TO_INCLUDE_MODE) {
@@ -177,13 +240,14 @@ void IGMPQuerier::push(int, Packet* p) {
 				        leave_timer->initialize(this);
 		 	                leave_timer->schedule_after_msec(_last_memb_query_interval);
 					_leaving_state.push_back(multicast_addr);
+					it->leaving = true;
 		                }
 		            }
 		    }
 		    
 
                     // Respond with Group-Specific Query
-                    Packet* p = make_packet(IPAddress(multicast_addr));
+                    Packet* p = make_packet(multicast_addr);
                     output(0).push(p);
 		    _ctr++;
                 }
@@ -192,26 +256,166 @@ void IGMPQuerier::push(int, Packet* p) {
                     // Set group timer for this group to GMI
                     for (auto it = _multicast_state.begin(); it !=  _multicast_state.end(); it++) {
                         if (it->group_addr == multicast_addr) {
+                            it->reports++;
                             it->group_timer->schedule_after_msec(_group_membership_interval);
                         }
                     }
                 }
-
-                record++;
             }
-        }        
-    } else if (iph->ip_p == 17) {
-        // UDP
+        }
+        // Reports are consumed by the querier
+        p->kill();
+    } else {
+        // Multicast UDP
         // Check if interface is interested in this group
         // If yes, send to output
         for (int i = 0; i < _multicast_state.size(); i++) {
             if (iph->ip_dst == _multicast_state[i].group_addr) {
+                _multicast_state[i].forwarded++;
                 output(0).push(p);
                 return;
                 
             }
         }
+        // No interest on this interface
+        _drops++;
+        p->kill();
+    }
+}
+
+bool IGMPQuerier::within_limits(IPAddress src, const IGMPAdmission::Rule* rule) const {
+    // Checks MAXGROUPS and the per-source limit of the matching rule for a new group
+    if (_max_groups > 0 && (uint) _multicast_state.size() >= _max_groups) {
+        return false;
+    }
+    if (rule && rule->limit >= 0 && _source_groups.get(RuleSource {rule->index, src}) >= rule->limit) {
+        return false;
     }
+    return true;
+}
+
+int IGMPQuerier::upper_group(IPAddress addr) const {
+    // Binary search, _multicast_state is ordered by group address
+    uint32_t key = ntohl(addr.addr());
+    int low = 0, high = _multicast_state.size();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (ntohl(_multicast_state[mid].group_addr.addr()) <= key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+uint IGMPQuerier::remaining_msec(const GroupState& group) {
+    if (!group.group_timer->scheduled()) {
+        return 0;
+    }
+    Timestamp remaining = group.group_timer->expiry_steady() - Timestamp::now_steady();
+    return remaining < Timestamp() ? 0 : remaining.msecval();
+}
+
+int IGMPQuerier::parse_page(const String& param, IGMPQuerier* elem, int& first, int& end, ErrorHandler* errh) {
+    // Format: [CURSOR [COUNT]]
+    // The cursor is the last group of the previous page, so groups that are
+    // added or removed while paging don't shift the rest of the table.
+    IPAddress cursor = IPAddress();
+    int count        = GROUPS_PAGE_DEFAULT;
+
+    Vector<String> vconf;
+    cp_spacevec(param, vconf);
+    if (Args(vconf, elem, errh).read_p("CURSOR", cursor)
+			       .read_p("COUNT", count)
+			       .complete() < 0)
+        return -1;
+
+    if (count <= 0) {
+        return errh->error("COUNT must be > 0");
+    }
+    if (count > GROUPS_PAGE_MAX) {
+        count = GROUPS_PAGE_MAX;
+    }
+
+    first = elem->upper_group(cursor);
+    end   = first + count;
+    if (end > elem->_multicast_state.size()) {
+        end = elem->_multicast_state.size();
+    }
+    return 0;
+}
+
+IPAddress IGMPQuerier::next_cursor(int end) const {
+    // Last group of the page, or 0.0.0.0 if the table has been read completely
+    return end < _multicast_state.size() ? _multicast_state[end - 1].group_addr : IPAddress();
+}
+
+int IGMPQuerier::handle_groups(int, String& data, Element* e, const Handler*, ErrorHandler* errh) {
+    // Text page of the group table, one group per line:
+    //   GROUP MODE TIMER_MS LEAVING REPORTS FORWARDED
+    // preceded by a line 'next CURSOR total TOTAL'. CURSOR is 0.0.0.0 at the end of the table.
+    IGMPQuerier* elem = (IGMPQuerier*) e;
+    int first, end;
+    if (parse_page(data, elem, first, end, errh) < 0)
+        return -1;
+
+    StringAccum sa((end - first + 1) * 64);
+    sa << "next " << elem->next_cursor(end) << " total " << elem->_multicast_state.size() << '\n';
+    for (int i = first; i < end; i++) {
+        const GroupState& group = elem->_multicast_state[i];
+        sa << group.group_addr << ' '
+           << (group.filter_mode == IGMP_MODE_IS_EXCLUDE ? "exclude" : "include") << ' '
+           << remaining_msec(group) << ' '
+           << (group.leaving ? 1 : 0) << ' '
+           << group.reports << ' '
+           << group.forwarded << '\n';
+    }
+    data = sa.take_string();
+    return 0;
+}
+
+int IGMPQuerier::handle_groups_bin(int, String& data, Element* e, const Handler*, ErrorHandler* errh) {
+    // Binary page of the group table, see GroupDumpHeader and GroupDumpRecord
+    IGMPQuerier* elem = (IGMPQuerier*) e;
+    int first, end;
+    if (parse_page(data, elem, first, end, errh) < 0)
+        return -1;
+
+    data = String::make_uninitialized(sizeof(GroupDumpHeader) + (end - first) * sizeof(GroupDumpRecord));
+    char* buf = data.mutable_data();
+
+    GroupDumpHeader* header = (GroupDumpHeader*) buf;
+    header->next  = elem->next_cursor(end).addr();
+    header->total = htonl(elem->_multicast_state.size());
+
+    GroupDumpRecord* record = (GroupDumpRecord*) (header + 1);
+    for (int i = first; i < end; i++) {
+        const GroupState& group = elem->_multicast_state[i];
+        record->group_addr  = group.group_addr.addr();
+        record->filter_mode = group.filter_mode;
+        record->leaving     = group.leaving;
+        record->resv        = 0;
+        record->timer_msec  = htonl(remaining_msec(group));
+        record->reports     = htonl(group.reports);
+        record->forwarded   = htonl(group.forwarded);
+        record++;
+    }
+    return 0;
+}
+
+String IGMPQuerier::read_group_count(Element* e, void*) {
+    IGMPQuerier* elem = (IGMPQuerier*) e;
+    return String(elem->_multicast_state.size());
+}
+
+void IGMPQuerier::add_handlers() {
+    add_data_handlers("drops", Handler::f_read, &_drops);
+    add_data_handlers("rejected", Handler::f_read, &_rejected);
+    add_data_handlers("rejected_limit", Handler::f_read, &_rejected_limit);
+    add_read_handler("group_count", &read_group_count, (void*)0);
+    set_handler("groups", Handler::f_read | Handler::f_read_param, &handle_groups);
+    set_handler("groups_bin", Handler::f_read | Handler::f_read_param, &handle_groups_bin);
 }
 
 void IGMPQuerier::handleGroupTimeout(Timer* timer, void* data) {
@@ -219,6 +423,13 @@ void IGMPQuerier::handleGroupTimeout(Timer* timer, void* data) {
     GroupTimerData* timerdata = (GroupTimerData*) data;
     for (auto it = timerdata->querier->_multicast_state.begin(); it != timerdata->querier->_multicast_state.end(); it++) {
         if (it->group_addr == timerdata->multicast_address) {
+            if (it->limit_rule >= 0) {
+                RuleSource key = RuleSource {it->limit_rule, it->reporter};
+                int& source_groups = timerdata->querier->_source_groups[key];
+                if (--source_groups <= 0) {
+                    timerdata->querier->_source_groups.erase(key);
+                }
+            }
             timerdata->querier->_multicast_state.erase(it);
 	        delete timer;
             return;
@@ -244,39 +455,15 @@ void IGMPQuerier::handleMemberLeave(Timer* timer, void* data) {
 			break;
 		}
 	}
+	int position = timerdata->querier->upper_group(timerdata->multicast_address);
+	if (position > 0 && timerdata->querier->_multicast_state[position - 1].group_addr == timerdata->multicast_address) {
+		timerdata->querier->_multicast_state[position - 1].leaving = false;
+	}
         delete timer;
     }
 }
 
 
-int igmp_code_to_ms(uint8_t code) {
-   /* Returns time in milliseconds from given code. Used for Max Resp Time & QQIC. */
-   if (code < 128) {
-	return code * 100;
-   }
-   else {
-	uint mant = (code & 0xf);
-	uint exp  = (code & 0x70) >> 4;
-	uint code = ((mant | 0x10) << (exp + 3)) * 100;
-	return code;
-   }
-}
-
-int igmp_ms_to_code(uint ms) {
-
-	if (ms < 12800) {
-		return ms / 100;
-	}
-
-	for (uint exp = 0; exp < 8; exp++) {
-		uint mant = (ms / 100) >> (exp + 3);
-		if (mant < 0x1f) {
-			return 0x80 | ((exp & 0x7) << 4) | (mant & 0xf);
-		}
-	}
-
-}
-
-
 CLICK_ENDDECLS
 EXPORT_ELEMENT(IGMPQuerier)
+ELEMENT_REQUIRES(IGMPAdmission IGMPCodec)
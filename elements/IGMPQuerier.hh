@@ -2,14 +2,22 @@
 #define CLICK_IGMPQuerier_HH
 #include <click/element.hh>
 #include <click/timer.hh>
+#include <click/hashtable.hh>
 #include <clicknet/ip.h>
 #include "IGMPHeaders.hh"
+#include "IGMPAdmission.hh"
+#include "IGMPCodec.hh"
 
 
 /*
     IGMP Querier - Router side IGMP component.
     Handles querying and forwarding of multicast UDP packets.
     All time values should be in milliseconds.
+
+    Input:
+        [0]: IGMP Membership Reports
+        [1]: Multicast UDP packets
+    Use IGMPClassify to split incoming traffic.
 */
 
 
@@ -17,6 +25,39 @@ struct GroupState {
     IPAddress group_addr;
     Timer* group_timer;
     int filter_mode;
+    uint32_t reports;   // Reports received for this group
+    uint32_t forwarded; // Multicast UDP packets forwarded to this group
+    IPAddress reporter; // Source of the report that created the group
+    int limit_rule;     // Admission rule whose limit this group counts against, -1 if none
+    bool leaving;       // Last member queries are being sent
+};
+
+// Key for the per-rule group count of a reporting source
+struct RuleSource {
+    int rule;
+    IPAddress src;
+
+    hashcode_t hashcode() const {return src.hashcode() + rule * 0x9e3779b1U;}
+    bool operator==(const RuleSource& other) const {return rule == other.rule && src == other.src;}
+};
+
+/*
+    Binary group table dump (groups_bin handler), all fields in network byte order.
+    A GroupDumpHeader is followed by one GroupDumpRecord per group.
+*/
+struct GroupDumpHeader {
+    uint32_t next;  // Cursor for the next page (last group returned), 0.0.0.0 at the end
+    uint32_t total; // Number of groups in the table
+};
+
+struct GroupDumpRecord {
+    uint32_t group_addr;
+    uint8_t  filter_mode;
+    uint8_t  leaving;
+    uint16_t resv;
+    uint32_t timer_msec; // Remaining group timer
+    uint32_t reports;
+    uint32_t forwarded;
 };
 
 
@@ -32,6 +73,21 @@ CLICK_DECLS
         SQI: Startup Query Interval, default = 1/4th of Query Interval
         SQC: Startup Query Count, default = Robustness Variable
         LMQC: Last Member Query Count, default = Robustness Variable
+        PHASE: Offset of the general queries within the Query Interval,
+               default = spread evenly over all IGMPQueriers in the router
+        JITTER: Random delay added to each general query after the startup queries, default = 0s
+        RULE: Admission rule 'permit|deny SOURCE GROUP [limit N]', may be repeated,
+              see IGMPAdmission. Checked for every record that joins or refreshes a group.
+        DEFAULT: Action if no rule matches, 'permit' or 'deny', default = permit
+        MAXGROUPS: Maximum number of groups on this interface, default = 0 (unlimited)
+
+    Handlers:
+        drops: Multicast UDP packets dropped because no member is interested
+        rejected: Report records rejected by the admission rules
+        rejected_limit: New groups rejected by MAXGROUPS or a rule's limit
+        group_count: Number of groups in the table
+        groups [CURSOR [COUNT]]: Page of the groups after address CURSOR, see handle_groups
+        groups_bin [CURSOR [COUNT]]: Same page in binary, see GroupDumpRecord
 */
 class IGMPQuerier : public Element {
     public:
@@ -40,15 +96,19 @@ class IGMPQuerier : public Element {
         ~IGMPQuerier();
 
         const char *class_name() const {return "IGMPQuerier";}
-        const char *port_count() const {return "1/1";}
+        const char *port_count() const {return "2/1";}
         const char *processing() const {return PUSH;}
         int configure(Vector<String>&, ErrorHandler*);
+        int initialize(ErrorHandler*);
         void run_timer(Timer*);
         Packet* make_packet(IPAddress);
         void push(int, Packet*);
+        void add_handlers();
 
     private:
 
+        enum { GROUPS_PAGE_DEFAULT = 64, GROUPS_PAGE_MAX = 1024 };
+
 	struct GroupTimerData {
             IGMPQuerier* querier;
             IPAddress multicast_address;
@@ -63,9 +123,28 @@ class IGMPQuerier : public Element {
         static void handleGroupTimeout(Timer*, void*);
 	static void handleMemberLeave(Timer*, void*);
 
+        bool within_limits(IPAddress, const IGMPAdmission::Rule*) const;
+
+        // Index of the first group with an address above the given one
+        int upper_group(IPAddress) const;
+
+        // Group table dump
+        static uint remaining_msec(const GroupState&);
+        static int parse_page(const String&, IGMPQuerier*, int&, int&, ErrorHandler*);
+        IPAddress next_cursor(int) const;
+        static int handle_groups(int, String&, Element*, const Handler*, ErrorHandler*);
+        static int handle_groups_bin(int, String&, Element*, const Handler*, ErrorHandler*);
+        static String read_group_count(Element*, void*);
+
         Timer     _query_timer;
+        Timestamp _next_query; // Nominal time of the next general query, without jitter
+        int       _query_phase;
+        uint      _query_jitter;
+        uint      _phase_shift;
+        bool      _phase_applied;
 	uint      _startup_query_interval;
 	uint      _startup_query_count;
+	uint      _startup_sent; // Startup queries sent so far
         uint      _query_interval = 125000;
         uint      _query_resp_interval = 10000;
 	uint      _last_memb_query_interval = 1000;
@@ -75,15 +154,21 @@ class IGMPQuerier : public Element {
 	uint      _max_resp_code_group_query;
         uint      _ctr;
         uint8_t   _s_qrv;
+        uint8_t   _qqic;
+        uint32_t  _drops; // Multicast UDP without interested members
+
+        // Admission
+        IGMPAdmission _admission;
+        bool      _default_permit;
+        uint      _max_groups;
+        uint32_t  _rejected;
+        uint32_t  _rejected_limit;
+        HashTable<RuleSource, int> _source_groups; // Groups created per (limited rule, reporting source)
         IPAddress _src;
-        Vector<GroupState> _multicast_state;
+        Vector<GroupState> _multicast_state; // Ordered by group address
 	Vector<IPAddress> _leaving_state;
 };
 
-int igmp_code_to_ms(uint8_t code);
-
-int igmp_ms_to_code(uint ms);
-
 CLICK_ENDDECLS
 
 #endif
@@ -22,37 +22,14 @@ int IGMPResponder::configure(Vector<String>& conf, ErrorHandler* errh) {
 }
 
 Packet* IGMPResponder::make_packet(Vector<igmp_group_record> records = Vector<igmp_group_record>()) {
-    size_t packetsize = sizeof(click_ip) + sizeof(IP_options) + sizeof(igmp_memb_report)
-                        + records.size() * sizeof(igmp_group_record);
-    WritablePacket* p = Packet::make(packetsize);
+    size_t igmp_len   = sizeof(igmp_memb_report) + records.size() * sizeof(igmp_group_record);
+    WritablePacket* p = igmp_make_packet(_src, IPAddress("224.0.0.22"), _ctr, igmp_len);
     if (p == 0) {
-        click_chatter("Failed to create packet.");
         return nullptr;
     }
-    memset(p->data(), 0, p->length());
-
-    // IP
-    click_ip* iph = (click_ip*) p->data();
-    iph->ip_v   = 4;
-    iph->ip_hl  = (sizeof(click_ip) + sizeof(IP_options)) >> 2;
-    iph->ip_len = htons(p->length());
-    iph->ip_id  = htons(_ctr);
-    iph->ip_ttl = 1;
-    iph->ip_p   = 2;
-    iph->ip_src = _src;
-    iph->ip_dst = IPAddress("224.0.0.22");
-
-    // IP Option: Router Alert
-    IP_options* ra = (IP_options*) (iph + 1);
-    ra->type = 148;
-    ra->length = 4;
-    ra->value = 0;
-
- 	iph->ip_sum = 0;
-    iph->ip_sum = click_in_cksum((unsigned char*) iph, sizeof(click_ip) + sizeof(IP_options));
-    
+
     // IGMP Report
-    igmp_memb_report* igmph 	 = (igmp_memb_report*) (ra + 1);
+    igmp_memb_report* igmph 	 = (igmp_memb_report*) igmp_payload(p);
     igmph->igmp_type             = IGMP_TYPE_MEMBERSHIP_REPORT;
     igmph->igmp_num_group_rec    = htons(records.size());
 
@@ -68,11 +45,7 @@ Packet* IGMPResponder::make_packet(Vector<igmp_group_record> records = Vector<ig
         record++;
     }
 
-    igmph->igmp_checksum = click_in_cksum((unsigned char*) igmph, sizeof(igmp_memb_report) + sizeof(igmp_group_record) * records.size());
-   
-    // Annotations
-    p->set_dst_ip_anno(IPAddress(iph->ip_dst));
-    p->set_ip_header(iph, sizeof(*iph));
+    igmph->igmp_checksum = igmp_checksum((unsigned char*) igmph, igmp_len);
 
     return p;
 }
@@ -90,9 +63,7 @@ void IGMPResponder::push(int, Packet* p) {
     // Accepts Query messages and starts appropriate timer if necessary.
     // Also accepts UDP messages and lets them through if appropriate.
 
-    WritablePacket* wp     = p->uniqueify();
-    click_ip* iph          = wp->ip_header();
-    IP_options* ipo        = (IP_options*) (iph + 1);
+    const click_ip* iph    = p->ip_header();
 
     if (iph->ip_p == 17) {
         // UDP Packets
@@ -106,16 +77,17 @@ void IGMPResponder::push(int, Packet* p) {
     }
     else if (iph->ip_p == 2) {
         // IGMP Packets
-        igmp_memb_query* igmph =  (igmp_memb_query*) (ipo + 1);
-	if (igmph->igmp_type == IGMP_TYPE_MEMBERSHIP_REPORT) {
+        IGMPQueryView query(p);
+	if (!query.valid()) {
+		p->kill();
 		return; // Ignore reports from the network
 	}
 
         // General queries
         Vector<igmp_group_record> records = Vector<igmp_group_record>();
-        if (igmph->igmp_group_address == 0 && igmph->igmp_num_sources == 0) {
+        if (!query.group() && query.num_sources() == 0) {
 
-		_last_qrv = igmph->igmp_S_QRV & IGMP_QRV_MASK;
+		_last_qrv = query.qrv();
 
                 // Only send response if state is non-empty
                 if (!_multicast_state.empty()) {
@@ -131,13 +103,13 @@ void IGMPResponder::push(int, Packet* p) {
         }
 
         // Group-specific queries
-        if (igmph->igmp_group_address > 0) {
+        if (query.group()) {
 
-	    _last_qrv = igmph->igmp_S_QRV & IGMP_QRV_MASK;
+	    _last_qrv = query.qrv();
             
             for (int i = 0; i < _multicast_state.size(); i++) {
                 
-                if (_multicast_state[i] == igmph->igmp_group_address) {
+                if (_multicast_state[i] == query.group()) {
                     igmp_group_record record;
                     record.igmp_record_type    = IGMP_MODE_IS_EXCLUDE;
                     record.igmp_aux_data       = 0;
@@ -150,8 +122,7 @@ void IGMPResponder::push(int, Packet* p) {
         }
 
         if (records.size() > 0 and !_response_timer.scheduled()) {
-            Packet* response = make_packet(records);
-            uint time_to_send = click_random(0, igmp_code_to_ms2(igmph->igmp_max_resp_code));
+            uint time_to_send = click_random(0, query.max_resp_ms());
             _response_timer.schedule_after_msec(time_to_send);
             for (auto record : records) {
                 bool already_pending = false;
@@ -166,6 +137,7 @@ void IGMPResponder::push(int, Packet* p) {
             }
         }
     }
+    p->kill();
 }
 
 int IGMPResponder::handle_join(const String &conf, Element* e, void* thunk, ErrorHandler* errh) {
@@ -293,17 +265,6 @@ void IGMPResponder::handleUnsolicitedMessage(Timer* timer, void* data) {
      }  
 }
 
-int igmp_code_to_ms2(uint8_t code) {
-   /* Returns time in milliseconds from given code. Used for Max Resp Time & QQIC. */
-   if (code < 128) {
-	return code * 100;
-   }
-   else {
-	uint8_t mant = (code & 0x10);
-	uint8_t exp  = (code >> 4) & 0x8;
-	return ((mant | 0x10) << (exp + 3)) * 100;
-   }
-}
-
 CLICK_ENDDECLS
 EXPORT_ELEMENT(IGMPResponder)
+ELEMENT_REQUIRES(IGMPCodec)
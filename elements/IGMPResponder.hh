@@ -4,6 +4,7 @@
 #include <click/timer.hh>
 #include <clicknet/ip.h>
 #include "IGMPHeaders.hh"
+#include "IGMPCodec.hh"
 
 
 CLICK_DECLS
@@ -56,8 +57,6 @@ class IGMPResponder : public Element {
         Vector<IPAddress> _leaving_state;
 };
 
-int igmp_code_to_ms2(uint8_t code);
-
 CLICK_ENDDECLS
 
 #endif
@@ -0,0 +1,310 @@
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/straccum.hh>
+#include <clicknet/ether.h>
+#include "IGMPSnooping.hh"
+
+CLICK_DECLS
+
+#define PORT_BIT(port) ((uint64_t) 1 << (port))
+
+IGMPSnooping::IGMPSnooping(): _gc_timer(this), _fast_leave(false), _all_ports(0), _pruned(0) {}
+
+IGMPSnooping::~IGMPSnooping() {}
+
+int IGMPSnooping::configure(Vector<String>& conf, ErrorHandler* errh) {
+
+    double gmi  = 260; // In seconds
+    double rpi  = 255; // In seconds
+    double lmqt = 2;   // In seconds
+
+    if (Args(conf, this, errh).read("GMI", gmi)
+			      .read("RPI", rpi)
+			      .read("LMQT", lmqt)
+			      .read("FASTLEAVE", _fast_leave)
+			      .complete() < 0) return -1;
+
+    if (ninputs() > MAX_PORTS) {
+        return errh->error("at most %d ports are supported", MAX_PORTS);
+    }
+
+    _group_membership_interval = (uint) (gmi * 1000);
+    _router_port_interval      = (uint) (rpi * 1000);
+    _last_member_time          = (uint) (lmqt * 1000);
+    _all_ports = ninputs() == MAX_PORTS ? ~(uint64_t) 0 : PORT_BIT(ninputs()) - 1;
+
+    return 0;
+}
+
+int IGMPSnooping::initialize(ErrorHandler*) {
+    _gc_timer.initialize(this);
+    _gc_timer.schedule_after_msec(1000);
+    return 0;
+}
+
+void IGMPSnooping::output_mask(uint64_t mask, Packet* p) {
+    // Sends p to every port in mask, cloning for all but the last port
+    if (!mask) {
+        _pruned++;
+        p->kill();
+        return;
+    }
+    while (mask) {
+        int port = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (!mask) {
+            output(port).push(p);
+            return;
+        }
+        if (Packet* q = p->clone()) {
+            output(port).push(q);
+        }
+    }
+}
+
+void IGMPSnooping::push(int port, Packet* p) {
+
+    uint64_t others = _all_ports & ~PORT_BIT(port);
+
+    // Ethernet, with optional 802.1Q tag
+    const click_ether* ethh = (const click_ether*) p->data();
+    if (p->length() < sizeof(click_ether) || !(ethh->ether_dhost[0] & 1)) {
+        output_mask(others, p);
+        return;
+    }
+
+    int vlan           = 0;
+    uint16_t ethertype = ethh->ether_type;
+    uint32_t offset    = sizeof(click_ether);
+    if (ethertype == htons(ETHERTYPE_8021Q)) {
+        const click_ether_vlan* vlanh = (const click_ether_vlan*) p->data();
+        if (p->length() < sizeof(click_ether_vlan)) {
+            output_mask(others, p);
+            return;
+        }
+        vlan      = ntohs(vlanh->ether_vlan_tci) & 0x0fff;
+        ethertype = vlanh->ether_vlan_encap_proto;
+        offset    = sizeof(click_ether_vlan);
+    }
+
+    if (ethertype != htons(ETHERTYPE_IP) || p->length() < offset + sizeof(click_ip)) {
+        output_mask(others, p);
+        return;
+    }
+
+    const click_ip* iph = (const click_ip*) (p->data() + offset);
+    IPAddress group     = IPAddress(iph->ip_dst);
+
+    if (iph->ip_p == IP_PROTO_IGMP) {
+        handle_igmp(port, vlan, iph, p);
+        return;
+    }
+
+    // Link local multicast is always flooded
+    if (!group.is_multicast() || (ntohl(group.addr()) & 0xffffff00) == 0xe0000000) {
+        output_mask(others, p);
+        return;
+    }
+
+    uint64_t mask = 0;
+    auto vit = _vlans.find(vlan);
+    if (vit != _vlans.end()) {
+        mask = vit.value().router_ports;
+        auto git = vit.value().groups.find(group);
+        if (git != vit.value().groups.end()) {
+            mask |= git.value().ports;
+        }
+    }
+    output_mask(mask & others, p);
+}
+
+void IGMPSnooping::handle_igmp(int port, int vlan, const click_ip* iph, Packet* p) {
+
+    uint64_t others    = _all_ports & ~PORT_BIT(port);
+    const uint8_t* igmp = (const uint8_t*) iph + (iph->ip_hl << 2);
+    const uint8_t* end  = p->end_data();
+
+    if (igmp + sizeof(igmp_memb_report) > end) {
+        output_mask(others, p);
+        return;
+    }
+
+    VlanState& vs = _vlans[vlan];
+    if (vs.router_expiry.size() == 0) {
+        vs.router_expiry.resize(ninputs());
+    }
+
+    switch (igmp[0]) {
+        case IGMP_TYPE_MEMBERSHIP_QUERY: {
+            // Queries come from a router
+            vs.router_ports |= PORT_BIT(port);
+            vs.router_expiry[port] = Timestamp::now_steady() + Timestamp::make_msec(_router_port_interval);
+            output_mask(others, p);
+            return;
+        }
+        case IGMP_TYPE_V2_MEMBERSHIP_REPORT:
+        case IGMP_TYPE_V2_LEAVE_GROUP: {
+            const igmp_memb_query* igmph = (const igmp_memb_query*) igmp;
+            if (igmp[0] == IGMP_TYPE_V2_MEMBERSHIP_REPORT) {
+                join(port, vlan, IPAddress(igmph->igmp_group_address));
+            } else {
+                leave(port, vlan, IPAddress(igmph->igmp_group_address));
+            }
+            break;
+        }
+        case IGMP_TYPE_MEMBERSHIP_REPORT: {
+            const igmp_memb_report* igmph = (const igmp_memb_report*) igmp;
+            IGMPRecordIterator record((const uint8_t*) (igmph + 1), end, ntohs(igmph->igmp_num_group_rec));
+
+            for (; record; ++record) {
+                IPAddress group_addr = record.group();
+
+                // Sources are not tracked, any record listening to the group makes the port a member
+                switch (record.type()) {
+                    case IGMP_MODE_IS_EXCLUDE:
+                    case IGMP_CHANGE_TO_EXCLUDE_MODE:
+                    case IGMP_ALLOW_NEW_SOURCES:
+                        join(port, vlan, group_addr);
+                        break;
+                    case IGMP_MODE_IS_INCLUDE:
+                    case IGMP_CHANGE_TO_INCLUDE_MODE:
+                        if (record.num_sources() > 0) {
+                            join(port, vlan, group_addr);
+                        } else {
+                            leave(port, vlan, group_addr);
+                        }
+                        break;
+                }
+            }
+            break;
+        }
+        default:
+            output_mask(others, p);
+            return;
+    }
+
+    // Reports are only sent to the routers
+    output_mask(vs.router_ports & others, p);
+}
+
+void IGMPSnooping::join(int port, int vlan, IPAddress group_addr) {
+
+    if (!group_addr.is_multicast()) {
+        return;
+    }
+
+    GroupEntry& entry = _vlans[vlan].groups[group_addr];
+    if (entry.expiry.size() == 0) {
+        entry.ports = 0;
+        entry.expiry.resize(ninputs());
+    }
+    entry.ports |= PORT_BIT(port);
+    entry.expiry[port] = Timestamp::now_steady() + Timestamp::make_msec(_group_membership_interval);
+}
+
+void IGMPSnooping::leave(int port, int vlan, IPAddress group_addr) {
+
+    auto git = _vlans[vlan].groups.find(group_addr);
+    if (git == _vlans[vlan].groups.end() || !(git.value().ports & PORT_BIT(port))) {
+        return;
+    }
+
+    GroupEntry& entry = git.value();
+    if (_fast_leave) {
+        entry.ports &= ~PORT_BIT(port);
+        if (!entry.ports) {
+            _vlans[vlan].groups.erase(git);
+        }
+        return;
+    }
+
+    // Other hosts on the port get the Last Member Query Time to report
+    Timestamp leave_time = Timestamp::now_steady() + Timestamp::make_msec(_last_member_time);
+    if (leave_time < entry.expiry[port]) {
+        entry.expiry[port] = leave_time;
+    }
+}
+
+void IGMPSnooping::run_timer(Timer*) {
+    // Remove expired router ports, memberships and empty groups
+    Timestamp now = Timestamp::now_steady();
+
+    for (auto vit = _vlans.begin(); vit != _vlans.end(); ++vit) {
+        VlanState& vs = vit.value();
+
+        for (uint64_t mask = vs.router_ports; mask; mask &= mask - 1) {
+            int port = __builtin_ctzll(mask);
+            if (vs.router_expiry[port] <= now) {
+                vs.router_ports &= ~PORT_BIT(port);
+            }
+        }
+
+        for (auto git = vs.groups.begin(); git != vs.groups.end(); ) {
+            GroupEntry& entry = git.value();
+            for (uint64_t mask = entry.ports; mask; mask &= mask - 1) {
+                int port = __builtin_ctzll(mask);
+                if (entry.expiry[port] <= now) {
+                    entry.ports &= ~PORT_BIT(port);
+                }
+            }
+            if (!entry.ports) {
+                git = vs.groups.erase(git);
+            } else {
+                ++git;
+            }
+        }
+    }
+
+    _gc_timer.reschedule_after_msec(1000);
+}
+
+static void append_ports(StringAccum& sa, uint64_t mask) {
+    // Comma separated port list, '-' when empty
+    if (!mask) {
+        sa << '-';
+    }
+    for (bool first = true; mask; mask &= mask - 1, first = false) {
+        if (!first) {
+            sa << ',';
+        }
+        sa << __builtin_ctzll(mask);
+    }
+}
+
+String IGMPSnooping::read_table(Element* e, void*) {
+    // One line per group: VLAN GROUP PORTS
+    IGMPSnooping* elem = (IGMPSnooping*) e;
+    StringAccum sa;
+    for (auto vit = elem->_vlans.begin(); vit != elem->_vlans.end(); ++vit) {
+        for (auto git = vit.value().groups.begin(); git != vit.value().groups.end(); ++git) {
+            sa << vit.key() << ' ' << git.key() << ' ';
+            append_ports(sa, git.value().ports);
+            sa << '\n';
+        }
+    }
+    return sa.take_string();
+}
+
+String IGMPSnooping::read_router_ports(Element* e, void*) {
+    // One line per VLAN: VLAN PORTS
+    IGMPSnooping* elem = (IGMPSnooping*) e;
+    StringAccum sa;
+    for (auto vit = elem->_vlans.begin(); vit != elem->_vlans.end(); ++vit) {
+        sa << vit.key() << ' ';
+        append_ports(sa, vit.value().router_ports);
+        sa << '\n';
+    }
+    return sa.take_string();
+}
+
+void IGMPSnooping::add_handlers() {
+    add_read_handler("table", &read_table, (void*)0);
+    add_read_handler("router_ports", &read_router_ports, (void*)0);
+    add_data_handlers("pruned", Handler::f_read, &_pruned);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IGMPSnooping)
+ELEMENT_REQUIRES(IGMPCodec)
@@ -0,0 +1,89 @@
+#ifndef CLICK_IGMPSnooping_HH
+#define CLICK_IGMPSnooping_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/hashtable.hh>
+#include <clicknet/ip.h>
+#include "IGMPHeaders.hh"
+#include "IGMPCodec.hh"
+
+
+/*
+    IGMP Snooping - Switch side IGMP component.
+    Constrains IPv4 multicast to the ports with interested members.
+    Input and output N correspond to switch port N (at most 64 ports).
+    Frames may carry an 802.1Q tag, membership is learned per VLAN.
+
+    - Queries mark the ingress port as router port and are flooded.
+    - Reports (IGMPv2 and v3) update the group memberships of the ingress
+      port and are only forwarded to router ports.
+    - Multicast data is forwarded to member ports and router ports.
+      Unknown groups only go to router ports.
+    - Link local multicast (224.0.0.0/24) and all other frames are flooded.
+      Put a Classifier in front to only send multicast frames here.
+    Expired memberships and router ports are removed once per second.
+*/
+
+
+CLICK_DECLS
+
+/*
+    Configuration parameters:
+        GMI: Group Membership Interval, default = 260s
+        RPI: Router port timeout, default = 255s (Other Querier Present Interval)
+        LMQT: Time a port stays member after a leave, default = 2s
+        FASTLEAVE: Remove a port immediately on leave, default = false
+*/
+class IGMPSnooping : public Element {
+    public:
+
+        IGMPSnooping();
+        ~IGMPSnooping();
+
+        const char *class_name() const {return "IGMPSnooping";}
+        const char *port_count() const {return "1-/=";}
+        const char *processing() const {return PUSH;}
+        int configure(Vector<String>&, ErrorHandler*);
+        int initialize(ErrorHandler*);
+        void run_timer(Timer*);
+        void push(int, Packet*);
+        void add_handlers();
+
+    private:
+
+        enum { MAX_PORTS = 64 };
+
+        struct GroupEntry {
+            uint64_t ports;           // Member ports
+            Vector<Timestamp> expiry; // Membership expiry per port
+        };
+
+        struct VlanState {
+            uint64_t router_ports;
+            Vector<Timestamp> router_expiry;
+            HashTable<IPAddress, GroupEntry> groups;
+
+            VlanState(): router_ports(0) {}
+        };
+
+        void handle_igmp(int, int, const click_ip*, Packet*);
+        void join(int, int, IPAddress);
+        void leave(int, int, IPAddress);
+        void output_mask(uint64_t, Packet*);
+
+        static String read_table(Element*, void*);
+        static String read_router_ports(Element*, void*);
+
+        Timer     _gc_timer;
+        uint      _group_membership_interval;
+        uint      _router_port_interval;
+        uint      _last_member_time;
+        bool      _fast_leave;
+        uint64_t  _all_ports;
+        uint32_t  _pruned; // Multicast frames without members or router ports
+        HashTable<int, VlanState> _vlans;
+};
+
+CLICK_ENDDECLS
+
+#endif
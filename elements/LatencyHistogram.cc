@@ -0,0 +1,107 @@
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/straccum.hh>
+#include "LatencyHistogram.hh"
+
+CLICK_DECLS
+
+LatencyHistogram::LatencyHistogram(): _count(0), _sum(0) {
+    memset(_buckets, 0, sizeof(_buckets));
+}
+
+LatencyHistogram::~LatencyHistogram() {}
+
+int LatencyHistogram::bucket_of(uint64_t ns) {
+    // Values below SUB_BUCKETS get their own bucket, larger values are
+    // split into SUB_BUCKETS linear buckets per power of two.
+    if (ns < SUB_BUCKETS) {
+        return ns;
+    }
+    int msb   = 63 - __builtin_clzll(ns);
+    int shift = msb - 4;
+    return (shift + 1) * SUB_BUCKETS + ((ns >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucket_value(int bucket) {
+    // Returns the midpoint of the bucket
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift    = bucket / SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t) (bucket % SUB_BUCKETS + SUB_BUCKETS) << shift;
+    return low + (((uint64_t) 1 << shift) >> 1);
+}
+
+Packet* LatencyHistogram::simple_action(Packet* p) {
+
+    const Timestamp& ts = p->timestamp_anno();
+    if (!ts) {
+        return p;
+    }
+
+    int64_t ns = (Timestamp::now() - ts).nsecval();
+    if (ns < 0) {
+        ns = 0;
+    }
+    _buckets[bucket_of(ns)]++;
+    _sum += ns;
+    _count++;
+
+    return p;
+}
+
+uint64_t LatencyHistogram::percentile(uint permille) const {
+
+    if (_count == 0) {
+        return 0;
+    }
+
+    uint64_t target = (_count * permille + 999) / 1000;
+    uint64_t seen   = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        seen += _buckets[i];
+        if (seen >= target) {
+            return bucket_value(i);
+        }
+    }
+    return bucket_value(NUM_BUCKETS - 1);
+}
+
+String LatencyHistogram::read_handler(Element* e, void* thunk) {
+    LatencyHistogram* elem = (LatencyHistogram*) e;
+    intptr_t which = (intptr_t) thunk;
+
+    StringAccum sa;
+    if (which == 0) {
+        sa << elem->_count;
+    } else if (which == 1) {
+        sa << (elem->_count ? elem->_sum / elem->_count : 0);
+    } else {
+        sa << elem->percentile(which);
+    }
+    return sa.take_string();
+}
+
+int LatencyHistogram::handle_reset(const String &conf, Element* e, void* thunk, ErrorHandler* errh) {
+    LatencyHistogram* elem = (LatencyHistogram*) e;
+    elem->_count = 0;
+    elem->_sum   = 0;
+    memset(elem->_buckets, 0, sizeof(elem->_buckets));
+    return 0;
+}
+
+void LatencyHistogram::add_handlers() {
+    // Percentile handlers pass their permille as thunk
+    add_read_handler("count", &read_handler, (void*)0);
+    add_read_handler("mean",  &read_handler, (void*)1);
+    add_read_handler("p50",   &read_handler, (void*)500);
+    add_read_handler("p90",   &read_handler, (void*)900);
+    add_read_handler("p99",   &read_handler, (void*)990);
+    add_read_handler("p999",  &read_handler, (void*)999);
+    add_write_handler("reset", &handle_reset, (void*)0, Handler::f_button);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(LatencyHistogram)
@@ -0,0 +1,55 @@
+#ifndef CLICK_LatencyHistogram_HH
+#define CLICK_LatencyHistogram_HH
+#include <click/element.hh>
+
+
+CLICK_DECLS
+
+/*
+    Latency Histogram - Benchmark helper.
+    Records the time between a packet's timestamp annotation (e.g. set by
+    SetTimestamp at the traffic source) and the moment it passes through
+    this element. Packets without a timestamp annotation are passed
+    through without being recorded.
+
+    Latencies are kept in a log-linear histogram (16 linear buckets per
+    power of two), so percentiles are accurate to within ~6%.
+
+    Handlers:
+        count: Number of recorded packets
+        mean: Mean latency (ns)
+        p50, p90, p99, p999: Latency percentiles (ns)
+        reset: Clear the histogram
+*/
+class LatencyHistogram : public Element {
+    public:
+
+        LatencyHistogram();
+        ~LatencyHistogram();
+
+        const char *class_name() const {return "LatencyHistogram";}
+        const char *port_count() const {return PORTS_1_1;}
+        const char *processing() const {return AGNOSTIC;}
+        Packet* simple_action(Packet*);
+        void add_handlers();
+
+        uint64_t percentile(uint permille) const;
+
+    private:
+
+        enum { SUB_BUCKETS = 16, NUM_BUCKETS = 61 * SUB_BUCKETS };
+
+        static int bucket_of(uint64_t ns);
+        static uint64_t bucket_value(int bucket);
+
+        static String read_handler(Element*, void*);
+        static int handle_reset(const String &conf, Element* e, void* thunk, ErrorHandler* errh);
+
+        uint64_t _count;
+        uint64_t _sum;
+        uint64_t _buckets[NUM_BUCKETS];
+};
+
+CLICK_ENDDECLS
+
+#endif
@@ -0,0 +1,19 @@
+#! /bin/bash
+#
+# Usage: bench.sh [GROUPS] [PACKETS]
+# Generates benchmark traffic and replays it through scripts/bench.click.
+# Run from the click directory, like the other scripts.
+
+groups=${1:-1000}
+packets=${2:-1000000}
+pcapdir=$(mktemp -d)
+
+python3 "$(dirname "$0")/gen-bench-pcap.py" --groups "$groups" --packets "$packets" --out-dir "$pcapdir"
+
+userlevel/click scripts/bench.click \
+	DATA="$pcapdir/bench-data.pcap" \
+	JOINS0="$pcapdir/bench-joins-0.pcap" \
+	JOINS1="$pcapdir/bench-joins-1.pcap" \
+	JOINS2="$pcapdir/bench-joins-2.pcap"
+
+rm -rf "$pcapdir"
@@ -0,0 +1,119 @@
+#! /usr/bin/env python3
+#
+# Generates the pcap files replayed by scripts/bench.click.
+#
+#   bench-joins-0.pcap .. bench-joins-2.pcap:
+#       IGMPv3 reports (CHANGE_TO_EXCLUDE_MODE) joining the benchmark groups.
+#       Group i is joined on interface i % 3.
+#   bench-data.pcap:
+#       Multicast UDP from the server network to the groups (round robin),
+#       interleaved with MODE_IS_EXCLUDE reports every --ctrl-every packets.
+#
+# Addresses match the AddressInfo in scripts/bench.click.
+
+import argparse
+import ipaddress
+import os
+import struct
+
+ROUTER_MAC = ["00:50:ba:85:84:a1", "00:50:ba:85:84:a2", "00:50:ba:85:84:a3"]
+HOST_MAC   = ["00:50:ba:85:84:b1", "00:50:ba:85:84:b2", "00:50:ba:85:84:b3"]
+HOST_IP    = ["192.168.1.1", "192.168.2.1", "192.168.3.1"]
+REPORT_DST = "224.0.0.22"
+
+IGMP_TYPE_MEMBERSHIP_REPORT = 0x22
+IGMP_MODE_IS_EXCLUDE        = 2
+IGMP_CHANGE_TO_EXCLUDE_MODE = 4
+RECORDS_PER_REPORT          = 64
+
+
+def mac(s):
+    return bytes(int(b, 16) for b in s.split(":"))
+
+
+def multicast_mac(group):
+    low = int(ipaddress.IPv4Address(group)) & 0x7fffff
+    return b"\x01\x00\x5e" + struct.pack("!I", low)[1:]
+
+
+def checksum(data):
+    if len(data) % 2:
+        data += b"\x00"
+    s = sum(struct.unpack("!%dH" % (len(data) // 2), data))
+    while s >> 16:
+        s = (s & 0xffff) + (s >> 16)
+    return ~s & 0xffff
+
+
+def ip_packet(src, dst, proto, ttl, payload, options=b""):
+    hl  = (20 + len(options)) // 4
+    hdr = struct.pack("!BBHHHBBH4s4s", 0x40 | hl, 0, hl * 4 + len(payload), 0, 0,
+                      ttl, proto, 0,
+                      ipaddress.IPv4Address(src).packed,
+                      ipaddress.IPv4Address(dst).packed) + options
+    hdr = hdr[:10] + struct.pack("!H", checksum(hdr)) + hdr[12:]
+    return hdr + payload
+
+
+def ether(dst, src, payload):
+    return dst + src + b"\x08\x00" + payload
+
+
+def report(interface, groups, record_type):
+    records = b"".join(struct.pack("!BBH4s", record_type, 0, 0, ipaddress.IPv4Address(g).packed)
+                       for g in groups)
+    igmp = struct.pack("!BBHHH", IGMP_TYPE_MEMBERSHIP_REPORT, 0, 0, 0, len(groups)) + records
+    igmp = igmp[:2] + struct.pack("!H", checksum(igmp)) + igmp[4:]
+    # Router Alert option
+    ra = struct.pack("!BBH", 148, 4, 0)
+    ip = ip_packet(HOST_IP[interface], REPORT_DST, 2, 1, igmp, ra)
+    return ether(multicast_mac(REPORT_DST), mac(HOST_MAC[interface]), ip)
+
+
+def udp(group, size):
+    payload = bytes(max(0, size - 14 - 20 - 8))
+    hdr = struct.pack("!HHHH", 1234, 1234, 8 + len(payload), 0)
+    ip = ip_packet(HOST_IP[0], group, 17, 64, hdr + payload)
+    return ether(multicast_mac(group), mac(HOST_MAC[0]), ip)
+
+
+def write_pcap(path, frames):
+    with open(path, "wb") as f:
+        f.write(struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for i, frame in enumerate(frames):
+            f.write(struct.pack("<IIII", i // 1000000, i % 1000000, len(frame), len(frame)))
+            f.write(frame)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate IGMP router benchmark traffic")
+    parser.add_argument("--groups", type=int, default=1000, help="number of multicast groups")
+    parser.add_argument("--packets", type=int, default=1000000, help="number of data packets")
+    parser.add_argument("--size", type=int, default=64, help="UDP frame size in bytes")
+    parser.add_argument("--ctrl-every", type=int, default=1000,
+                        help="insert a report every N data packets (0 disables)")
+    parser.add_argument("--base", default="225.1.0.0", help="first group address")
+    parser.add_argument("--out-dir", default=".", help="output directory")
+    args = parser.parse_args()
+
+    base   = int(ipaddress.IPv4Address(args.base))
+    groups = [str(ipaddress.IPv4Address(base + i)) for i in range(args.groups)]
+
+    for interface in range(3):
+        mine = groups[interface::3]
+        frames = [report(interface, mine[i:i + RECORDS_PER_REPORT], IGMP_CHANGE_TO_EXCLUDE_MODE)
+                  for i in range(0, len(mine), RECORDS_PER_REPORT)]
+        write_pcap(os.path.join(args.out_dir, "bench-joins-%d.pcap" % interface), frames)
+
+    def data():
+        for i in range(args.packets):
+            if args.ctrl_every and i % args.ctrl_every == args.ctrl_every - 1:
+                yield report(0, [groups[(i // args.ctrl_every * 3) % len(groups)]], IGMP_MODE_IS_EXCLUDE)
+            else:
+                yield udp(groups[i % len(groups)], args.size)
+
+    write_pcap(os.path.join(args.out_dir, "bench-data.pcap"), data())
+
+
+if __name__ == "__main__":
+    main()